@@ -0,0 +1,95 @@
+/* -----------------------------------------------------------------
+   MspTandV Library Example Sketch
+   https://github.com/Andy4495/MspTandV
+   MIT License
+
+   18-Oct-2026 Andy4495 Original
+*/
+/* -----------------------------------------------------------------
+
+   Shows ADC arbitration between an interrupt handler and loop().
+
+   Timer A0 interrupts about 250 times a second and reads pin 10
+   with MspAdc. At the same time, loop() reads Vcc with MspVcc.
+   When the timer interrupt arrives while loop() is in the middle
+   of a Vcc reading, the MspAdc read is queued instead of changing
+   the voltage reference under the Vcc reading.
+
+   Every second, the sketch prints how many interrupt reads
+   completed immediately and how many were deferred, along with
+   the MspAdcArbiter counters.
+
+   This example is written generically enough that it
+   probably works on all supported processors, but it uses
+   Timer A0, so it cannot be combined with analogWrite() or
+   tone() on pins that use Timer A0.
+
+*/
+
+#include "MspTandV.h"
+
+const unsigned long delayTime = 1000;
+unsigned long prevMillis = 0;
+
+// Read pin 10 and use voltage reference 1
+MspAdc myAdc(10, 1);
+MspVcc myVcc;
+
+volatile uint16_t isrReadsCompleted = 0;
+volatile uint16_t isrReadsDeferred = 0;
+
+void setup() {
+
+  Serial.begin(9600);
+
+  // Timer A0 in up mode from SMCLK / 8, interrupting about 250 times a second
+  TA0CCR0 = F_CPU / 8UL / 250UL;
+  TA0CCTL0 = CCIE;
+  TA0CTL = TASSEL_2 | ID_3 | MC_1 | TACLR;
+}
+
+void loop() {
+
+  uint16_t completed, deferred;
+
+  // Keep the ADC busy from loop() so that some timer reads are deferred
+  myVcc.read();
+
+  if (millis() - prevMillis > delayTime) {
+    prevMillis = millis();
+
+    noInterrupts();
+    completed = isrReadsCompleted;
+    deferred = isrReadsDeferred;
+    isrReadsCompleted = 0;
+    isrReadsDeferred = 0;
+    interrupts();
+
+    Serial.print("Vcc (mV): ");
+    Serial.print(myVcc.getVccCalibrated());
+    Serial.print("  ADC calibrated: ");
+    Serial.println(myAdc.getAdcCalibrated());
+    Serial.print("ISR read() true, false: ");
+    Serial.print(completed);
+    Serial.print(", ");
+    Serial.println(deferred);
+    Serial.print("Contention, deferred, coalesced, dropped: ");
+    Serial.print(MspAdcArbiter::getContentionCount());
+    Serial.print(", ");
+    Serial.print(MspAdcArbiter::getDeferredCount());
+    Serial.print(", ");
+    Serial.print(MspAdcArbiter::getCoalescedCount());
+    Serial.print(", ");
+    Serial.println(MspAdcArbiter::getDroppedCount());
+    Serial.println("");
+    MspAdcArbiter::clearCounts();
+  }
+}
+
+__attribute__((interrupt(TIMER0_A0_VECTOR)))
+void Timer_A0_ISR(void) {
+  if (myAdc.read())
+    isrReadsCompleted++;
+  else
+    isrReadsDeferred++;
+}
@@ -9,6 +9,8 @@
                        calibration (i.e., use lower-voltage ref first). This is
                        to properly support G2 processors in low voltage
                        configurations.
+   10/18/2026 - A.T. - Add MspAdcArbiter so that reads from interrupt
+                       handlers and loop() do not corrupt each other.
 */
 /*
    Library to retrieve chip temperature and Vcc measurement.
@@ -46,11 +48,197 @@
         TempF = myMspTemp.getTempCalibratedF();    // Degrees Fahrenheit * 10
         TempC = MyMspTemp.getTempCalibratedC();    // Degrees Celsius * 10
         Vcc_mV = MyMspVcc.getVccCalibrated();      // Voltage in mV
+   4. read() may be called from an interrupt handler. If the ADC is
+      already in use, the read is queued and run when the current owner
+      finishes, and read() returns false. A read queued while the owner
+      is already running queued reads waits until the next library
+      read. The getters return the previous values until then.
 */
 
 #include "MspTandV.h"
 #include "Arduino.h"
 
+volatile bool     MspAdcArbiter::owned = false;
+volatile uint16_t MspAdcArbiter::currentRef = DEFAULT;
+uint16_t          MspAdcArbiter::savedRef = DEFAULT;
+MspAdcArbiter::PendingRead MspAdcArbiter::pending[MSPTANDV_PENDING_READS];
+volatile uint8_t  MspAdcArbiter::pendingHead = 0;
+volatile uint8_t  MspAdcArbiter::pendingCount = 0;
+volatile uint16_t MspAdcArbiter::contentionCount = 0;
+volatile uint16_t MspAdcArbiter::deferredCount = 0;
+volatile uint16_t MspAdcArbiter::coalescedCount = 0;
+volatile uint16_t MspAdcArbiter::droppedCount = 0;
+volatile uint16_t MspAdcArbiter::refErrorCount = 0;
+
+// The MSP430 has no compare-and-swap instruction, so the test-and-set
+// of the ownership flag and the queue updates are done with interrupts
+// masked for a few instructions. The caller never waits for the ADC.
+bool MspAdcArbiter::tryAcquire() {
+  bool acquired = false;
+  unsigned int state = __get_interrupt_state();
+  __disable_interrupt();
+  if (!owned) {
+    owned = true;
+    acquired = true;
+  }
+  else {
+    contentionCount++;
+  }
+  __set_interrupt_state(state);
+  // Only the owner touches savedRef, so no need to mask interrupts
+  if (acquired) savedRef = currentRef;
+  return acquired;
+}
+
+void MspAdcArbiter::release() {
+  PendingRead req;
+  uint8_t toRun;
+  unsigned int state;
+
+  // Must only follow a successful tryAcquire(). Releasing without holding
+  // the ADC would unlock it under another caller's conversion.
+  if (!owned) return;
+
+  // Run the reads that were queued while we owned the ADC. Only the reads
+  // already queued when the drain starts are run; an interrupt that keeps
+  // asking for reads faster than they complete would otherwise keep the
+  // owner here forever. Anything queued during the drain stays pending
+  // until the next library read releases the ADC.
+  state = __get_interrupt_state();
+  __disable_interrupt();
+  toRun = pendingCount;
+  __set_interrupt_state(state);
+  while (toRun-- > 0) {
+    __disable_interrupt();
+    // An object destroyed during the drain takes its entries with it
+    if (pendingCount == 0) break;
+    req = pending[pendingHead];
+    pendingHead = (pendingHead + 1) % MSPTANDV_PENDING_READS;
+    pendingCount--;
+    __set_interrupt_state(state);
+    run(req);
+  }
+  // Put back the reference that was in effect when the ADC was acquired.
+  // The input channel does not need restoring since analogRead() selects
+  // it on every conversion.
+  if (currentRef != savedRef) {
+    currentRef = savedRef;
+    analogReference(savedRef);
+  }
+  owned = false;
+}
+
+// Must only be called between a successful tryAcquire() and release().
+// Changing the reference without holding the ADC could switch it under
+// a conversion in progress, so the request is refused and counted
+// separately from contention since it is a misuse of the API. The
+// reference is restored by release().
+bool MspAdcArbiter::setReference(uint16_t ref) {
+  if (!owned) {
+    unsigned int state = __get_interrupt_state();
+    __disable_interrupt();
+    refErrorCount++;
+    __set_interrupt_state(state);
+    return false;
+  }
+  currentRef = ref;
+  analogReference(ref);
+  return true;
+}
+
+uint16_t MspAdcArbiter::getContentionCount() {
+  return contentionCount;
+}
+
+uint16_t MspAdcArbiter::getDeferredCount() {
+  return deferredCount;
+}
+
+uint16_t MspAdcArbiter::getCoalescedCount() {
+  return coalescedCount;
+}
+
+uint16_t MspAdcArbiter::getDroppedCount() {
+  return droppedCount;
+}
+
+uint16_t MspAdcArbiter::getRefErrorCount() {
+  return refErrorCount;
+}
+
+void MspAdcArbiter::clearCounts() {
+  unsigned int state = __get_interrupt_state();
+  __disable_interrupt();
+  contentionCount = 0;
+  deferredCount = 0;
+  coalescedCount = 0;
+  droppedCount = 0;
+  refErrorCount = 0;
+  __set_interrupt_state(state);
+}
+
+void MspAdcArbiter::defer(uint8_t type, void* obj, uint8_t meas_type) {
+  uint8_t i, idx;
+  unsigned int state = __get_interrupt_state();
+  __disable_interrupt();
+  // A high-rate interrupt may ask for the same object several times
+  // before it gets a turn; a single queued read covers all of them.
+  for (i = 0; i < pendingCount; i++) {
+    idx = (pendingHead + i) % MSPTANDV_PENDING_READS;
+    if (pending[idx].obj == obj) {
+      // Keep the more complete measurement if the requests differ
+      if (meas_type == CAL_AND_UNCAL) pending[idx].meas_type = meas_type;
+      coalescedCount++;
+      __set_interrupt_state(state);
+      return;
+    }
+  }
+  if (pendingCount < MSPTANDV_PENDING_READS) {
+    idx = (pendingHead + pendingCount) % MSPTANDV_PENDING_READS;
+    pending[idx].obj = obj;
+    pending[idx].type = type;
+    pending[idx].meas_type = meas_type;
+    pendingCount++;
+    deferredCount++;
+  }
+  else {
+    droppedCount++;
+  }
+  __set_interrupt_state(state);
+}
+
+// Remove any queued reads for obj, keeping the rest in order.
+void MspAdcArbiter::cancel(void* obj) {
+  uint8_t i, src, kept = 0;
+  unsigned int state = __get_interrupt_state();
+  __disable_interrupt();
+  for (i = 0; i < pendingCount; i++) {
+    src = (pendingHead + i) % MSPTANDV_PENDING_READS;
+    if (pending[src].obj != obj) {
+      pending[(pendingHead + kept) % MSPTANDV_PENDING_READS] = pending[src];
+      kept++;
+    }
+  }
+  pendingCount = kept;
+  __set_interrupt_state(state);
+}
+
+void MspAdcArbiter::run(const PendingRead& req) {
+  switch (req.type) {
+    case TEMP_REQ:
+      ((MspTemp*)req.obj)->convert(req.meas_type);
+      break;
+    case VCC_REQ:
+      ((MspVcc*)req.obj)->convert(req.meas_type);
+      break;
+    case ADC_REQ:
+      ((MspAdc*)req.obj)->convert();
+      break;
+    default:
+      break;
+  }
+}
+
 MspTemp::MspTemp() {
   // Tc and uncalAdcScaleFactor calculated in constructor and stored with object.
   Tc = 550000L / ((long)*(int*)ADC_CAL_T85 - (long)*(int*)ADC_CAL_T30);
@@ -66,12 +254,29 @@ MspTemp::MspTemp() {
 
 }
 
-void MspTemp::read(int meas_type) {
+MspTemp::~MspTemp() {
+  // Don't leave a queued read pointing at a destroyed object
+  MspAdcArbiter::cancel(this);
+}
+
+bool MspTemp::read(int meas_type) {
+    if (!MspAdcArbiter::tryAcquire()) {
+      MspAdcArbiter::defer(MspAdcArbiter::TEMP_REQ, this, meas_type);
+      return false;
+    }
+    // This read supersedes any read of the same object still queued
+    MspAdcArbiter::cancel(this);
+    convert(meas_type);
+    MspAdcArbiter::release();
+    return true;
+}
+
+void MspTemp::convert(int meas_type) {
     long c2ftemp;
     int  ADCraw;
 
     // MSP430 internal temp sensor
-    analogReference(TEMP_VREF);
+    MspAdcArbiter::setReference(TEMP_VREF);
     ADCraw = analogRead(TEMPSENSOR_CHAN);
     ADCraw = analogRead(TEMPSENSOR_CHAN);
     CalibratedTempC = (Tc * (ADCraw - ((long)*(int*)ADC_CAL_T30)) + 300000L) / 1000L;
@@ -118,7 +323,24 @@ MspVcc::MspVcc() {
     Vref1Calibration = *(unsigned int*)ADC_CAL_REF1_FACTOR;
 }
 
-void MspVcc::read(int meas_type){
+MspVcc::~MspVcc() {
+  // Don't leave a queued read pointing at a destroyed object
+  MspAdcArbiter::cancel(this);
+}
+
+bool MspVcc::read(int meas_type){
+    if (!MspAdcArbiter::tryAcquire()) {
+      MspAdcArbiter::defer(MspAdcArbiter::VCC_REQ, this, meas_type);
+      return false;
+    }
+    // This read supersedes any read of the same object still queued
+    MspAdcArbiter::cancel(this);
+    convert(meas_type);
+    MspAdcArbiter::release();
+    return true;
+}
+
+void MspVcc::convert(int meas_type){
     long msp430mV, msp430mV_unc, ADCcalibrated;
     unsigned int  ADCraw, ADCrawXoverRef;
 
@@ -130,7 +352,7 @@ void MspVcc::read(int meas_type){
     // First try the lower reference voltage, since the G2 microcontrollers
     // need a higher Vcc for proper operation of the higher reference voltage.
     if (VCC_TYPE == VCCDIV2){
-      analogReference(VCC_REF2);
+      MspAdcArbiter::setReference(VCC_REF2);
       ADCraw = analogRead(VCC_CHAN);
       if (meas_type == CAL_AND_UNCAL) {
         // Need calculation to be Long int due to mV scaling
@@ -141,7 +363,7 @@ void MspVcc::read(int meas_type){
         msp430mV_unc = ADCraw * 200L * (long)VCC_REF2_DV;
         msp430mV_unc = msp430mV_unc / (long)ADC_STEPS;
         if (msp430mV_unc > VCC_XOVER) {
-          analogReference(VCC_REF1);
+          MspAdcArbiter::setReference(VCC_REF1);
           ADCrawXoverRef = analogRead(VCC_CHAN);
           msp430mV_unc = ADCrawXoverRef * 200L * (long)VCC_REF1_DV;
           msp430mV_unc = msp430mV_unc / (long)ADC_STEPS;
@@ -161,7 +383,7 @@ void MspVcc::read(int meas_type){
       msp430mV = ((unsigned long)ADCcalibrated * 200UL * (unsigned long)VCC_REF2_DV / (unsigned long)ADC_STEPS) + 0x0008UL; // Add 8 to round up if bit 3 is 1
       msp430mV = (msp430mV >> 4); // Shift 4 to adjust for scaling above
       if (msp430mV > VCC_XOVER) {
-        analogReference(VCC_REF1);
+        MspAdcArbiter::setReference(VCC_REF1);
         ADCrawXoverRef = analogRead(VCC_CHAN);
         ADCcalibrated = ((unsigned long)ADCrawXoverRef * (*(unsigned int*)ADC_CAL_REF1_FACTOR)) >> 13;
         ADCcalibrated = (ADCcalibrated * (*(unsigned int*)ADC_CAL_GAIN_FACTOR)) >> 13;
@@ -178,7 +400,7 @@ void MspVcc::read(int meas_type){
       //  --> Vcc = Vref * ADC_STEPS / ADCraw
       // This ADC type only has one reference, so there is no crossover
       // voltage check needed
-      analogReference(DEFAULT);
+      MspAdcArbiter::setReference(DEFAULT);
       ADCraw = analogRead(REF1_CHAN);
       if (meas_type == CAL_AND_UNCAL) {
         // Measure ADC reference voltage wrt Vcc
@@ -251,7 +473,24 @@ MspAdc::MspAdc(uint8_t channel, uint8_t voltage_ref_number) {
 
 }
 
-void MspAdc::read() {
+MspAdc::~MspAdc() {
+  // Don't leave a queued read pointing at a destroyed object
+  MspAdcArbiter::cancel(this);
+}
+
+bool MspAdc::read() {
+    if (!MspAdcArbiter::tryAcquire()) {
+      MspAdcArbiter::defer(MspAdcArbiter::ADC_REQ, this, CAL_ONLY);
+      return false;
+    }
+    // This read supersedes any read of the same object still queued
+    MspAdcArbiter::cancel(this);
+    convert();
+    MspAdcArbiter::release();
+    return true;
+}
+
+void MspAdc::convert() {
     long ADCcalibrated;
 
     // voltage_ref_number is one of [0, 1, 2] and is processor-dependent
@@ -262,16 +501,16 @@ void MspAdc::read() {
 
     switch (_voltage_ref) {
       case 0: 
-        analogReference(VCC_REF0);
+        MspAdcArbiter::setReference(VCC_REF0);
         break;
       case 1:
-        analogReference(VCC_REF1);
+        MspAdcArbiter::setReference(VCC_REF1);
         break;
       case 2:
-        analogReference(VCC_REF2);
+        MspAdcArbiter::setReference(VCC_REF2);
         break;
       default:
-        analogReference(DEFAULT);
+        MspAdcArbiter::setReference(DEFAULT);
         break;
     }
     ADCraw = analogRead(_channel);
@@ -4,6 +4,8 @@
    MIT License
 
    01/16/2018 - A.T. - Original
+   10/18/2026 - A.T. - Add MspAdcArbiter. read() now returns bool to
+                       indicate whether the reading was taken or queued.
 */
 /*
    Library to retrieve chip temperature and Vcc measurement.
@@ -28,49 +30,114 @@
 
 enum MEAS_TYPE {CAL_AND_UNCAL, CAL_ONLY};
 
+// Maximum number of reads that can be waiting for the ADC at one time.
+// Can be overridden with a -D compiler flag.
+#ifndef MSPTANDV_PENDING_READS
+#define MSPTANDV_PENDING_READS 4
+#endif
+
+class MspTemp;
+class MspVcc;
+class MspAdc;
+
+// Arbitrates ADC ownership between loop() and interrupt handlers.
+// A read() that finds the ADC busy is queued instead of switching the
+// reference under the conversion in progress; queued reads are run by
+// the current owner before it gives up the ADC. An object whose read()
+// returned false must still exist when the queued read runs; destroying
+// it removes its queued read.
+class MspAdcArbiter {
+public:
+  static bool tryAcquire();
+  static void release();
+  static bool setReference(uint16_t ref);  // Only while holding the ADC
+  static uint16_t getContentionCount();   // read() or tryAcquire() calls that found the ADC busy
+  static uint16_t getDeferredCount();     // reads queued and run later
+  static uint16_t getCoalescedCount();    // read() calls merged into a queued read
+  static uint16_t getDroppedCount();      // reads lost because the queue was full
+  static uint16_t getRefErrorCount();     // setReference() calls without holding the ADC
+  static void clearCounts();
+
+private:
+  enum REQ_TYPE {TEMP_REQ, VCC_REQ, ADC_REQ};
+  struct PendingRead {
+    void*   obj;
+    uint8_t type;
+    uint8_t meas_type;
+  };
+  static void defer(uint8_t type, void* obj, uint8_t meas_type);
+  static void run(const PendingRead& req);
+  static void cancel(void* obj);
+
+  static volatile bool     owned;
+  static volatile uint16_t currentRef;
+  static uint16_t          savedRef;
+  static PendingRead       pending[MSPTANDV_PENDING_READS];
+  static volatile uint8_t  pendingHead;
+  static volatile uint8_t  pendingCount;
+  static volatile uint16_t contentionCount;
+  static volatile uint16_t deferredCount;
+  static volatile uint16_t coalescedCount;
+  static volatile uint16_t droppedCount;
+  static volatile uint16_t refErrorCount;
+
+  friend class MspTemp;
+  friend class MspVcc;
+  friend class MspAdc;
+};
+
 class MspTemp {
 public:
   MspTemp();
-  void read(int meas_type = CAL_AND_UNCAL);
+  ~MspTemp();
+  bool read(int meas_type = CAL_AND_UNCAL);
   int getTempCalibratedC();
   int getTempUncalibratedC();
   int getTempCalibratedF();
   int getTempUncalibratedF();
 private:
+  void convert(int meas_type);
   int CalibratedTempC;      // Degrees * 10
   int CalibratedTempF;      // Degrees * 10
   int UncalibratedTempC;    // Degrees * 10
   int UncalibratedTempF;    // Degrees * 10
   long Tc;                  // Temperature calibration factor
   long uncalAdcScaleFactor; // Scaling factor used in uncalibrated calc
+  friend class MspAdcArbiter;
 };
 
 class MspVcc {
 public:
   MspVcc();
-  void read(int meas_type = CAL_AND_UNCAL);
+  ~MspVcc();
+  bool read(int meas_type = CAL_AND_UNCAL);
   int getVccCalibrated();
   int getVccUncalibrated();
 
 private:
+  void convert(int meas_type);
   int CalibratedVcc;       // milliVolts
   int UncalibratedVcc;     // milliVolts
   unsigned int Vref1Calibration;
+  friend class MspAdcArbiter;
 };
 
 class MspAdc {
 public:
   MspAdc(uint8_t channel, uint8_t voltage_ref_number);
-  void read();
+  ~MspAdc();
+  bool read();
   uint16_t getAdcCalibrated();
   uint16_t getAdcRaw();
 
 private:
+  void convert();
   uint16_t CalibratedAdc;
   uint16_t ADCraw;
   uint16_t VrefCalibration;
   uint8_t  _channel;
   uint8_t  _voltage_ref;
+  friend class MspAdcArbiter;
 };
 
 enum VCC_TYPE {VCCDIV2, VCC};